@@ -1,4 +1,5 @@
 #include <map>
+#include <set>
 #include <sstream>
 #include <iostream>
 #include <string>
@@ -6,95 +7,477 @@
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <optional>
+#include <cmath>
+#include <csignal>
 
 #include <pqxx/pqxx>
 #include <sw/redis++/redis++.h>
 
 #include "CLI/CLI.hpp"
 #include "utils.hpp"
+#include "ttl_tuner.hpp"
+#include "sketch.hpp"
+#include "trace.hpp"
+#include "invalidation.hpp"
+#include "invalidation_target.hpp"
 
 const bool DEBUG = false;
 const char* channel = "data_update";
 const std::chrono::milliseconds time_uncertainty_ms{500};
+// worst case time from a write until its invalidation is decided, tuned TTLs never go below it plus the uncertainty
+const std::chrono::milliseconds notification_latency_ms{100};
+const std::chrono::seconds housekeeping_interval{1};
+const size_t sketch_width = 2048;
+const size_t sketch_depth = 4;
+const size_t sketch_top_k = 10;
+// most keys handled by one pass, their invalidations are sent as one batch per Redis server
+const size_t max_batch_size = 256;
 
-void handle_event(sw::redis::Redis &redis_conn, std::string key) {
-    redis_conn.del(key);
+// set from SIGUSR1 to dump the invalidation statistics on demand
+std::atomic<bool> stats_requested{false};
+
+void handle_event(InvalidationTarget &target, const std::vector<std::string> &keys) {
+    target.del(keys);
 }
 
 class NotificationHandler : public pqxx::notification_receiver {
-    std::map<std::string, sw::redis::Redis> redis_connections;
+    // state of a key inside the in-flight table, a key that is written again while
+    // its invalidation is running is marked for rerun so a final pass happens after the last write
+    enum class KeyState { queued, running, rerun };
+    struct NodeStats {
+        std::atomic<long long> sent{0};
+        std::atomic<long long> skipped{0};
+    };
+
+    std::map<std::string, std::unique_ptr<InvalidationTarget>> redis_connections;
+    std::string postgres_uri_;
+    pqxx::connection worker_conn_;
     std::atomic<int> queries_saved_;
     std::atomic<int> total_queries_;
+    std::atomic<int> merged_events_;
+    std::atomic<int> ttl_updates_;
+    std::unique_ptr<TtlTuner> tuner_;
+    std::chrono::seconds tune_interval_;
+    std::chrono::steady_clock::time_point next_tune_;
+    // invalidations sent and skipped per parameter and sent per node/parameter
+    HeavyHitters sent_;
+    HeavyHitters skipped_;
+    HeavyHitters node_sent_;
+    std::map<std::string, NodeStats> node_stats_;
+    std::chrono::seconds stats_interval_;
+    std::chrono::steady_clock::time_point next_stats_;
+    TraceWriter* trace_;
+    std::mutex pending_lock_;
+    std::condition_variable pending_cv_;
+    std::deque<std::string> pending_;
+    std::unordered_map<std::string, KeyState> in_flight_;
+    bool stopping_;
+    std::thread worker_;
 public:
-    NotificationHandler(pqxx::connection_base & c, const std::string & channel, std::map<std::string, std::string>& redis_data)
+    NotificationHandler(pqxx::connection_base & c, const std::string & channel, const std::string & postgres_uri, std::map<std::string, std::string>& redis_data,
+                        const std::optional<TtlTuner::Config>& ttl_config, std::chrono::seconds tune_interval, std::chrono::seconds stats_interval,
+                        TraceWriter* trace)
         : pqxx::notification_receiver(c, channel),
+        postgres_uri_(postgres_uri),
+        worker_conn_(postgres_uri),
         queries_saved_(0),
-        total_queries_(0)
+        total_queries_(0),
+        merged_events_(0),
+        ttl_updates_(0),
+        tune_interval_(tune_interval),
+        next_tune_(std::chrono::steady_clock::now() + tune_interval),
+        sent_(sketch_width, sketch_depth, sketch_top_k),
+        skipped_(sketch_width, sketch_depth, sketch_top_k),
+        node_sent_(sketch_width, sketch_depth, sketch_top_k),
+        stats_interval_(stats_interval),
+        next_stats_(std::chrono::steady_clock::now() + stats_interval),
+        trace_(trace),
+        stopping_(false)
     {
+        if (ttl_config) {
+            tuner_ = std::make_unique<TtlTuner>(*ttl_config);
+        }
         std::for_each(redis_data.begin(), redis_data.end(), [this](auto &elem) {
-            redis_connections.emplace(std::pair<std::string, sw::redis::Redis>(elem.first, "tcp://" + elem.second + "?keep_alive=true"));
+            redis_connections.emplace(elem.first, make_invalidation_target(elem.second));
+            node_stats_[elem.first];
         });
+        worker_ = std::thread(&NotificationHandler::worker_loop, this);
     }
+    ~NotificationHandler() { stop(); }
     int get_queries_saved() { return queries_saved_; }
     int get_total_queries() { return total_queries_; }
+    int get_merged_events() { return merged_events_; }
+    int get_ttl_updates() { return ttl_updates_; }
+    long long get_round_trips()
+    {
+        long long round_trips = 0;
+        for (auto &[username, conn] : redis_connections) {
+            round_trips += conn->round_trips();
+        }
+        return round_trips;
+    }
 
+    /**
+     * waits for all queued invalidations to finish and stops the worker
+    */
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(pending_lock_);
+            stopping_ = true;
+        }
+        pending_cv_.notify_all();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+    }
+
+    /**
+     * one line per sketch with its top keys, then one line with the counters of every node.
+     * the sketches are halved after every dump, the node counters are never halved and count since start
+    */
+    void dump_stats(std::ostream &out)
+    {
+        sent_.dump(out, "sent");
+        skipped_.dump(out, "skipped");
+        node_sent_.dump(out, "node_sent");
+        out << "nodes_all_time";
+        for (auto &[username, stats] : node_stats_) {
+            out << " " << username << ":sent=" << stats.sent << ",skipped=" << stats.skipped;
+        }
+        out << std::endl;
+    }
+
+    /**
+     * notifications only queue the key, if the key is already queued or running the event is merged into it
+    */
     void operator() (const std::string & payload, int pid) override
     {
-        const std::string data_table = "parameter_data";
-        const std::string log_table = "read_log";
-        std::map<std::string, std::chrono::system_clock::time_point> user_to_read_times;
-        std::string query = "SELECT username, read_timestamp FROM " + log_table + " WHERE parameter_name = $1";
+        if (trace_) {
+            trace_->record(TraceEvent::notification, "", payload);
+        }
+        if (tuner_) {
+            // every notification is a write, even the ones merged below
+            tuner_->record_write(payload, std::chrono::system_clock::now());
+        }
+        std::lock_guard<std::mutex> lock(pending_lock_);
+        auto [iter, inserted] = in_flight_.try_emplace(payload, KeyState::queued);
+        if (inserted) {
+            pending_.push_back(payload);
+            pending_cv_.notify_one();
+            return;
+        }
+        merged_events_++;
+        if (iter->second == KeyState::running) {
+            iter->second = KeyState::rerun;
+        }
+    }
 
-        pqxx::read_transaction txn(conn());
-        pqxx::result result = txn.exec_params(query, payload);
+private:
+    void worker_loop()
+    {
+        std::unique_lock<std::mutex> lock(pending_lock_);
+        auto has_work = [this]() { return stopping_ || !pending_.empty(); };
+        while (true) {
+            // wake up at least every housekeeping interval so periodic work also runs when idle
+            pending_cv_.wait_for(lock, housekeeping_interval, has_work);
+            lock.unlock();
+            housekeeping();
+            lock.lock();
+            if (pending_.empty()) {
+                if (stopping_) {
+                    return;
+                }
+                continue;
+            }
+            std::vector<std::string> keys;
+            while (!pending_.empty() && keys.size() < max_batch_size) {
+                keys.push_back(std::move(pending_.front()));
+                pending_.pop_front();
+                in_flight_[keys.back()] = KeyState::running;
+            }
+            lock.unlock();
+            std::set<std::string> failed = invalidate(keys);
+            if (failed.size()) {
+                reconnect();
+            }
+            lock.lock();
+            for (const auto &key : keys) {
+                auto iter = in_flight_.find(key);
+                bool retry = failed.count(key) && !stopping_;
+                if (iter->second == KeyState::rerun || retry) {
+                    // the key was written while we were running or its pass failed, run it again
+                    iter->second = KeyState::queued;
+                    pending_.push_back(key);
+                } else {
+                    if (failed.count(key)) {
+                        std::cerr << "Error: giving up the invalidation of " << key << " on exit" << std::endl;
+                    }
+                    in_flight_.erase(iter);
+                }
+            }
+            if (failed.size()) {
+                // do not spin on a database or Redis server that is down
+                pending_cv_.wait_for(lock, housekeeping_interval, [this]() { return stopping_; });
+            }
+        }
+    }
 
-        // Check if a row was returned
-        if (result.empty()) {
-            queries_saved_++;
+    /**
+     * replaces a broken worker connection, the keys that failed on it are retried on the new one
+    */
+    void reconnect()
+    {
+        if (worker_conn_.is_open()) {
             return;
         }
+        try {
+            worker_conn_ = pqxx::connection(postgres_uri_);
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
 
-        // Iterate through the rows and populate the dictionary
-        for (const auto &row : result) {
-            auto username = row["username"].c_str();
-            std::string timestamp_str = row["read_timestamp"].c_str();
-            user_to_read_times[username] = parse_time(timestamp_str);
+    void housekeeping()
+    {
+        auto now = std::chrono::steady_clock::now();
+        try {
+            if (tuner_ && now >= next_tune_) {
+                tune_ttls();
+                next_tune_ = now + tune_interval_;
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            reconnect();
         }
-        // get the TS data is still valid
-        query = "SELECT ttl, timestamp FROM " + data_table + " WHERE parameter_name = $1";
-        result = txn.exec_params(query, payload);
-        if (result.empty()) {
-            std::cerr << "No matching rows found for parameter_name1: " << payload << std::endl;
+        bool stats_due = stats_interval_.count() > 0 && now >= next_stats_;
+        if (stats_requested.exchange(false) || stats_due) {
+            dump_stats(std::cout);
+            sent_.halve();
+            skipped_.halve();
+            node_sent_.halve();
+            next_stats_ = now + stats_interval_;
+        }
+    }
+
+    /**
+     * moves the ttl of every written parameter a step toward the tuner target in one statement.
+     * raising a ttl is always safe, the invalidator only sends more invalidations than needed.
+     * lowering it is only done once the current ttl expired, otherwise cached values
+     * would outlive the end of life the invalidator computes
+    */
+    void tune_ttls()
+    {
+        const std::string data_table = "parameter_data";
+        auto targets = tuner_->targets(std::chrono::system_clock::now());
+        if (targets.empty()) {
             return;
         }
-        double ttl_ms = result[0]["ttl"].as<double>();
-        std::string timestamp_str = result[0]["timestamp"].c_str();
+        std::vector<std::string> names;
+        std::vector<double> target_ttls;
+        names.reserve(targets.size());
+        target_ttls.reserve(targets.size());
+        for (auto &[name, target] : targets) {
+            names.push_back(std::move(name));
+            target_ttls.push_back(target);
+        }
+        std::string next_ttl = "(d.ttl + $3::double precision * (t.ttl - d.ttl))";
+        std::string query = "UPDATE " + data_table + " d SET ttl = " + next_ttl +
+            " FROM unnest($1::text[], $2::double precision[]) AS t(parameter_name, ttl)"
+            " WHERE d.parameter_name = t.parameter_name AND abs(" + next_ttl + " - d.ttl) >= 1 AND"
+            " (t.ttl >= d.ttl OR d.timestamp + d.ttl * interval '1 millisecond' < NOW() - $4::double precision * interval '1 millisecond')";
+        pqxx::work txn(worker_conn_);
+        pqxx::result result = txn.exec_params(query, names, target_ttls, tuner_->step(), (double)time_uncertainty_ms.count());
+        txn.commit();
+        ttl_updates_ += static_cast<int>(result.affected_rows());
+    }
+
+    // a read_log row as selected, a reader that reads again refreshes read_timestamp of the same row
+    struct LogRow {
+        long long id;
+        std::string read_timestamp;
+    };
 
+    // read_log rows of one key and the ttl of the key in the data table
+    struct KeyReads {
+        std::map<std::string, std::vector<LogRow>> read_ids; // username -> read_log rows
+        // username -> timestamp of the newest value the node read, empty when a row did not log it
+        std::map<std::string, std::optional<std::chrono::system_clock::time_point>> value_times;
+        std::optional<double> ttl_ms;
+    };
 
-        // Create a system_clock time_point with microseconds
-        std::chrono::system_clock::time_point param_eol_time = parse_time(timestamp_str);
-        param_eol_time += std::chrono::microseconds((long long)(ttl_ms));
+    /**
+     * decides the whole batch from one query and then sends one batch to every Redis server in parallel.
+     * the read_log rows of a node are only deleted once its DEL succeeded, so after a failure
+     * the next write of the key still finds the reader and invalidates it again.
+     * returns the keys that have to be retried because the query or one of their DELs failed
+    */
+    std::set<std::string> invalidate(const std::vector<std::string> & keys)
+    {
+        const std::string data_table = "parameter_data";
+        const std::string log_table = "read_log";
+        std::map<std::string, KeyReads> reads;
+        try {
+            pqxx::read_transaction txn(worker_conn_);
+            pqxx::result result = txn.exec_params("SELECT r.id, r.read_timestamp, r.parameter_name, r.username, r.value_timestamp, d.ttl FROM " + log_table +
+                " r LEFT JOIN " + data_table + " d ON d.parameter_name = r.parameter_name WHERE r.parameter_name = ANY($1)", keys);
+            for (const auto &row : result) {
+                auto &key_reads = reads[row["parameter_name"].c_str()];
+                std::string username = row["username"].c_str();
+                key_reads.read_ids[username].push_back({row["id"].as<long long>(), row["read_timestamp"].c_str()});
+                std::optional<std::chrono::system_clock::time_point> value_time;
+                if (!row["value_timestamp"].is_null()) {
+                    value_time = parse_time(row["value_timestamp"].c_str());
+                }
+                auto [last, inserted] = key_reads.value_times.try_emplace(username, value_time);
+                if (!inserted && last->second && value_time) {
+                    last->second = std::max(*last->second, *value_time);
+                } else if (!inserted) {
+                    last->second.reset();
+                }
+                if (!row["ttl"].is_null()) {
+                    key_reads.ttl_ms = row["ttl"].as<double>();
+                }
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return std::set<std::string>(keys.begin(), keys.end());
+        }
+
+        std::map<std::string, std::vector<std::string>> deletes;
+        std::map<std::string, std::vector<LogRow>> pending_ids;
+        std::vector<LogRow> done_ids;
         auto now = std::chrono::system_clock::now();
+        for (const auto &payload : keys) {
+            auto iter = reads.find(payload);
+            if (iter == reads.end()) {
+                queries_saved_++;
+                // counted per node like the decisions, nobody read the key so every node is skipped
+                skipped_.add(payload, node_stats_.size());
+                for (auto &[username, stats] : node_stats_) {
+                    stats.skipped++;
+                }
+                if (trace_) {
+                    trace_->record(TraceEvent::skip, "", payload, static_cast<uint32_t>(TraceSkipReason::no_readers));
+                }
+                continue;
+            }
+            if (!iter->second.ttl_ms) {
+                std::cerr << "No matching rows found for parameter_name1: " << payload << std::endl;
+                continue;
+            }
+            decide(payload, iter->second, now, deletes, pending_ids, done_ids);
+        }
+
+        std::vector<std::string> usernames;
+        for (const auto &[username, user_keys] : deletes) {
+            usernames.push_back(username);
+        }
+        std::vector<char> succeeded(usernames.size(), 0);
         std::vector<std::thread> threads;
+        for (size_t i = 0; i < usernames.size(); i++) {
+            InvalidationTarget &target = *redis_connections.at(usernames[i]);
+            const std::vector<std::string> &user_keys = deletes[usernames[i]];
+            threads.emplace_back([&target, &user_keys, &succeeded, i]() {
+                try {
+                    handle_event(target, user_keys);
+                    succeeded[i] = 1;
+                } catch (const std::exception &e) {
+                    std::cerr << "Error: " << e.what() << std::endl;
+                }
+            });
+        }
+        // Wait for all threads to finish
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+        // delete values from log_table since they are not needed anymore
+        std::set<std::string> failed;
+        for (size_t i = 0; i < usernames.size(); i++) {
+            if (succeeded[i]) {
+                auto &ids = pending_ids[usernames[i]];
+                done_ids.insert(done_ids.end(), ids.begin(), ids.end());
+            } else {
+                auto &user_keys = deletes[usernames[i]];
+                failed.insert(user_keys.begin(), user_keys.end());
+            }
+        }
+        if (done_ids.empty()) {
+            return failed;
+        }
+        std::vector<long long> ids;
+        std::vector<std::string> read_timestamps;
+        for (const auto &row : done_ids) {
+            ids.push_back(row.id);
+            read_timestamps.push_back(row.read_timestamp);
+        }
+        try {
+            // a row that was read again after our SELECT belongs to a newer copy and is kept
+            pqxx::work txn(worker_conn_);
+            txn.exec_params("DELETE FROM " + log_table + " r USING unnest($1::integer[], $2::timestamp[]) AS t(id, read_timestamp)"
+                            " WHERE r.id = t.id AND r.read_timestamp <= t.read_timestamp", ids, read_timestamps);
+            txn.commit();
+        } catch (const std::exception &e) {
+            // the rows are kept, later writes of these keys only send extra invalidations
+            std::cerr << "Error: " << e.what() << std::endl;
+            reconnect();
+        }
+        return failed;
+    }
+
+    void decide(const std::string & payload, const KeyReads & key_reads, std::chrono::system_clock::time_point now,
+                std::map<std::string, std::vector<std::string>> & deletes,
+                std::map<std::string, std::vector<LogRow>> & pending_ids, std::vector<LogRow> & done_ids)
+    {
         // need to send notifications only to the relavent Redis servers
         for (auto& [username, conn] : redis_connections) {
             total_queries_++;
-            auto iter = user_to_read_times.find(username);
-            if (iter != user_to_read_times.end() && (now + time_uncertainty_ms) < param_eol_time) {
+            auto iter = key_reads.read_ids.find(username);
+            bool was_read = iter != key_reads.read_ids.end();
+            // the copy of the node ends with the value it read, the row's own timestamp is the write we are handling.
+            // a reader that did not log the timestamp of its value is always invalidated
+            std::chrono::system_clock::time_point param_eol_time;
+            auto decision = was_read ? InvalidationDecision::invalidate : InvalidationDecision::not_read;
+            if (was_read && key_reads.value_times.at(username)) {
+                param_eol_time = param_end_of_life(*key_reads.value_times.at(username), *key_reads.ttl_ms);
+                decision = decide_invalidation(was_read, now, param_eol_time, time_uncertainty_ms);
+            }
+            if (decision == InvalidationDecision::invalidate) {
                 if (DEBUG) {
                     std::cout << "user:" << username << " key:" << payload << " deleted " << "t1:" <<
                             now.time_since_epoch().count() << " t2 " << param_eol_time.time_since_epoch().count() << " delta " <<
                             std::max(now.time_since_epoch().count(), param_eol_time.time_since_epoch().count())  -
                             std::min(now.time_since_epoch().count(), param_eol_time.time_since_epoch().count())<< std::endl;
                 }
-                threads.emplace_back([payload, &conn]() {
-                    handle_event(conn, payload);
-                });
+                sent_.add(payload);
+                node_sent_.add(username + "/" + payload);
+                node_stats_[username].sent++;
+                if (trace_) {
+                    trace_->record(TraceEvent::invalidate, username, payload);
+                }
+                deletes[username].push_back(payload);
+                auto &ids = pending_ids[username];
+                ids.insert(ids.end(), iter->second.begin(), iter->second.end());
             }
             else
             {
                 queries_saved_++;
-                if (iter == user_to_read_times.end())
+                skipped_.add(payload);
+                node_stats_[username].skipped++;
+                if (was_read) {
+                    done_ids.insert(done_ids.end(), iter->second.begin(), iter->second.end());
+                }
+                if (trace_) {
+                    auto reason = decision == InvalidationDecision::not_read ? TraceSkipReason::not_read : TraceSkipReason::expired;
+                    trace_->record(TraceEvent::skip, username, payload, static_cast<uint32_t>(reason));
+                }
+                if (decision == InvalidationDecision::not_read)
                 {
                     if (DEBUG) {
                         std::cout << "user:" << username << " key:" << payload << " not deleted " << std::endl;
@@ -103,7 +486,7 @@ public:
                 else
                 {
                     if (DEBUG) {
-                        auto redis_t_val = conn.get(payload);
+                        auto redis_t_val = conn->get(payload);
                         std::string redis_val;
                         if (redis_t_val) {
                             redis_val = *redis_t_val;
@@ -119,13 +502,11 @@ public:
                 }
             }
         }
-        // delete values from log_table since they are not needed anymore
-        query = "DELETE FROM " + log_table + " WHERE parameter_name = $1";
-        result = txn.exec_params(query, payload);
-
-        // Wait for all threads to finish
-        for (std::thread &thread : threads) {
-            thread.join();
+        // readers that are not one of our caches
+        for (const auto &[username, ids] : key_reads.read_ids) {
+            if (!redis_connections.count(username)) {
+                done_ids.insert(done_ids.end(), ids.begin(), ids.end());
+            }
         }
     };
 };
@@ -141,12 +522,23 @@ int main(int argc, char* argv[]) {
     std::map<std::string, std::string> redis_data;
     std::string redis_str;
     int retries = 20;
+    double ttl_target = 0;
+    int tune_interval = 10;
+    int stats_interval = 0;
+    std::string trace_path;
+    TtlTuner::Config ttl_config;
     app.add_option("--postgres-host", postgres_host, "PostgresDB host name")->required();
     app.add_option("--postgres-db-name", postgres_db_name, "PostgresDB db name")->required();
     app.add_option("--postgres-db-username", postgres_db_username, "PostgresDB username");
     app.add_option("--postgres-db-password", postgres_db_password, "PostgresDB password");
-    app.add_option("--redis-servers", redis_str, "comma separated list of \"username:redis_server_ip:port\"")->required();
+    app.add_option("--redis-servers", redis_str, "comma separated list of \"username@redis_server_ip:port\" or \"username@cluster:redis_server_ip:port\"")->required();
     app.add_option("--timeout", retries, "how many times to query for events, each time 10 seconds");
+    app.add_option("--ttl-target", ttl_target, "tune TTLs for this expected number of invalidations per cached value, 0 keeps TTLs static");
+    app.add_option("--ttl-tune-interval", tune_interval, "seconds between TTL tuning rounds");
+    app.add_option("--ttl-min-ms", ttl_config.min_ttl_ms, "lowest TTL the tuner assigns");
+    app.add_option("--ttl-max-ms", ttl_config.max_ttl_ms, "highest TTL the tuner assigns");
+    app.add_option("--stats-interval", stats_interval, "seconds between invalidation statistics dumps, 0 dumps only on SIGUSR1 and exit");
+    app.add_option("--trace", trace_path, "append notifications and invalidation decisions to this binary trace file");
     CLI11_PARSE(app);
 
     std::string postgres_uri = "host=" + postgres_host + " " + "dbname=" + postgres_db_name;
@@ -164,11 +556,35 @@ int main(int argc, char* argv[]) {
             std::cerr << "Failed to open database" << std::endl;
             return 1;
         }
-        NotificationHandler handler(conn, channel, redis_data);
+        std::unique_ptr<TraceWriter> trace;
+        if (trace_path.size()) {
+            trace = std::make_unique<TraceWriter>(trace_path);
+        }
+        std::optional<TtlTuner::Config> tuner_config;
+        double min_safe_ttl_ms = (time_uncertainty_ms + notification_latency_ms).count();
+        if (ttl_target > 0 && ttl_config.min_ttl_ms < min_safe_ttl_ms) {
+            std::cerr << "--ttl-min-ms raised to " << min_safe_ttl_ms << ", a lower TTL is inside the invalidation uncertainty" << std::endl;
+            ttl_config.min_ttl_ms = min_safe_ttl_ms;
+        }
+        if (ttl_target > 0 && ttl_config.max_ttl_ms < ttl_config.min_ttl_ms) {
+            std::cerr << "--ttl-max-ms must not be lower than --ttl-min-ms" << std::endl;
+            return 1;
+        }
+        if (ttl_target > 0) {
+            ttl_config.target_invalidations = ttl_target;
+            tuner_config = ttl_config;
+        }
+        NotificationHandler handler(conn, channel, postgres_uri, redis_data, tuner_config, std::chrono::seconds{tune_interval},
+                                    std::chrono::seconds{stats_interval}, trace.get());
+        std::signal(SIGUSR1, [](int) { stats_requested = true; });
         for (int i = 0; i < retries; i++) {
             conn.await_notification();
         }
-        std::cout << "total queries:"<<handler.get_total_queries() << " saved queries:" << handler.get_queries_saved() << std::endl;
+        handler.stop();
+        std::cout << "total queries:"<<handler.get_total_queries() << " saved queries:" << handler.get_queries_saved() <<
+            " merged events:" << handler.get_merged_events() << " ttl updates:" << handler.get_ttl_updates() <<
+            " redis round trips:" << handler.get_round_trips() << std::endl;
+        handler.dump_stats(std::cout);
     } catch (const std::exception &e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
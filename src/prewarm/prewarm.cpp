@@ -0,0 +1,239 @@
+#include <map>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <tuple>
+#include <algorithm>
+#include <stdexcept>
+
+#include <pqxx/pqxx>
+#include <sw/redis++/redis++.h>
+
+#include "CLI/CLI.hpp"
+
+const std::string data_table = "parameter_data";
+const std::string log_table = "read_log";
+// same as Client::read_param, values that expire sooner are not worth caching
+const long long min_cache_time_ms = 50;
+
+std::atomic<long long> rows_read{0};
+std::atomic<long long> keys_set{0};
+std::atomic<long long> keys_deleted{0};
+std::atomic<long long> keys_failed{0};
+std::atomic<int> failed_workers{0};
+
+struct PendingKey {
+    std::string key;
+    std::string value;
+    std::string timestamp;
+    std::chrono::steady_clock::time_point expiry;
+};
+
+/**
+ * the rows of one worker, parameter_data is split into id ranges [lo, hi) so every worker scans only its range of the index
+*/
+std::string partition(long long lo, long long hi)
+{
+    return "id >= " + std::to_string(lo) + " AND id < " + std::to_string(hi) +
+        " AND timestamp + ttl * interval '1 millisecond' > clock_timestamp() + interval '" + std::to_string(min_cache_time_ms) + " milliseconds'";
+}
+
+/**
+ * a write that committed after its row was streamed can be invalidated before the PSETEX of the old value,
+ * so the timestamps of the keys set are read again afterwards and the keys that changed are deleted
+*/
+void recheck(pqxx::connection &conn, sw::redis::Redis &redis, const std::vector<const PendingKey*> &written)
+{
+    if (written.empty()) {
+        return;
+    }
+    std::vector<std::string> keys;
+    for (const auto *pending : written) {
+        keys.push_back(pending->key);
+    }
+    std::map<std::string, std::string> timestamps;
+    {
+        pqxx::read_transaction txn(conn);
+        pqxx::result result = txn.exec_params("SELECT parameter_name, timestamp::text FROM " + data_table +
+                                              " WHERE parameter_name = ANY($1)", keys);
+        for (const auto &row : result) {
+            timestamps.emplace(row[0].c_str(), row[1].c_str());
+        }
+    }
+    auto pipe = redis.pipeline(false);
+    std::vector<std::string> changed;
+    for (const auto *pending : written) {
+        auto iter = timestamps.find(pending->key);
+        if (iter == timestamps.end() || iter->second != pending->timestamp) {
+            pipe.del(pending->key);
+            changed.push_back(pending->key);
+        }
+    }
+    if (changed.empty()) {
+        return;
+    }
+    auto replies = pipe.exec();
+    for (size_t i = 0; i < changed.size(); i++) {
+        // a key we could not delete may be stale until its TTL, fail the worker instead of reporting it warmed
+        try {
+            replies.get(i);
+        } catch (const sw::redis::Error &e) {
+            throw std::runtime_error("Failed to delete changed key " + changed[i] + ": " + e.what());
+        }
+    }
+    keys_deleted += changed.size();
+}
+
+void flush(pqxx::connection &conn, sw::redis::Redis &redis, std::vector<PendingKey> &batch)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto pipe = redis.pipeline(false);
+    std::vector<const PendingKey*> written;
+    for (const auto &pending : batch) {
+        auto ttl = std::chrono::duration_cast<std::chrono::milliseconds>(pending.expiry - now);
+        if (ttl.count() > min_cache_time_ms) {
+            pipe.psetex(pending.key, ttl, pending.value);
+            written.push_back(&pending);
+        }
+    }
+    if (written.size()) {
+        auto replies = pipe.exec();
+        // QueuedReplies::get throws the error of a reply, like MOVED from a cluster node, READONLY from a replica or OOM
+        std::vector<const PendingKey*> set;
+        for (size_t i = 0; i < written.size(); i++) {
+            try {
+                replies.get(i);
+                set.push_back(written[i]);
+            } catch (const sw::redis::Error &e) {
+                if (keys_failed++ == 0) {
+                    std::cerr << "Error setting " << written[i]->key << ": " << e.what() << std::endl;
+                }
+            }
+        }
+        recheck(conn, redis, set);
+        keys_set += set.size();
+    }
+    batch.clear();
+}
+
+/**
+ * logs the reads of the partition first and commits them, so every write from now on invalidates
+ * this cache, then streams the values with COPY and fills Redis with their remaining TTL.
+ * the stream keeps its connection busy, the batches are rechecked on a second one
+*/
+void prewarm_worker(const std::string &postgres_uri, const std::string &redis_server, long long lo, long long hi, int worker, size_t batch_size)
+{
+    try {
+        pqxx::connection conn(postgres_uri);
+        pqxx::connection check_conn(postgres_uri);
+        sw::redis::Redis redis("tcp://" + redis_server + "?keep_alive=true");
+        {
+            pqxx::work txn(conn);
+            // the value set later may be newer than the one we could log here, an unknown value_timestamp is always invalidated
+            txn.exec("UPDATE " + log_table + " SET read_timestamp = NOW(), value_timestamp = NULL WHERE username = session_user AND parameter_name IN "
+                     "(SELECT parameter_name FROM " + data_table + " WHERE " + partition(lo, hi) + ")");
+            txn.exec("INSERT INTO " + log_table + " (username, read_timestamp, parameter_name) "
+                     "SELECT session_user, NOW(), p.parameter_name FROM " + data_table + " p WHERE " + partition(lo, hi) +
+                     " AND NOT EXISTS (SELECT 1 FROM " + log_table + " r WHERE r.username = session_user AND r.parameter_name = p.parameter_name)");
+            txn.commit();
+        }
+
+        pqxx::read_transaction txn(conn);
+        auto stream = pqxx::stream_from::query(txn,
+            "SELECT parameter_name, COALESCE(parameter_value, ''), timestamp::text, "
+            "(EXTRACT(EPOCH FROM (timestamp + ttl * interval '1 millisecond' - clock_timestamp())) * 1000)::bigint FROM " +
+            data_table + " p WHERE " + partition(lo, hi) +
+            // only rows whose read is logged, a row that was written after the reads were logged is not
+            " AND EXISTS (SELECT 1 FROM " + log_table + " r WHERE r.username = session_user AND r.parameter_name = p.parameter_name)");
+        std::vector<PendingKey> batch;
+        batch.reserve(batch_size);
+        std::tuple<std::string, std::string, std::string, long long> row;
+        while (stream >> row) {
+            auto &[key, value, timestamp, remaining_ms] = row;
+            rows_read++;
+            batch.push_back({std::move(key), std::move(value), std::move(timestamp),
+                             std::chrono::steady_clock::now() + std::chrono::milliseconds(remaining_ms)});
+            if (batch.size() >= batch_size) {
+                flush(check_conn, redis, batch);
+            }
+        }
+        stream.complete();
+        flush(check_conn, redis, batch);
+    } catch (const std::exception &e) {
+        std::cerr << "Error in worker " << worker << ": " << e.what() << std::endl;
+        failed_workers++;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    CLI::App app{"Consistant cache pre-warm"};
+    std::string footer = std::string("Example:\n") + argv[0] + " --postgres-host 192.168.0.1 --postgres-db-name my_db  --postgres-db-username username1 --postgres-db-password password --redis-server 192.168.0.2:6379 --workers 8";
+    app.footer(footer);
+    std::string postgres_host;
+    std::string postgres_db_name;
+    std::string postgres_db_username;
+    std::string postgres_db_password;
+    std::string redis_server;
+    int workers = 0;
+    size_t batch_size = 1000;
+    app.add_option("--postgres-host", postgres_host, "PostgresDB host name")->required();
+    app.add_option("--postgres-db-name", postgres_db_name, "PostgresDB db name")->required();
+    app.add_option("--postgres-db-username", postgres_db_username, "PostgresDB username of the cache, the reads are logged for it");
+    app.add_option("--postgres-db-password", postgres_db_password, "PostgresDB password");
+    app.add_option("--redis-server", redis_server, "redis_server_ip:port of the cache to fill")->required();
+    app.add_option("--workers", workers, "number of parallel workers, each with its own connections");
+    app.add_option("--batch-size", batch_size, "keys sent to Redis in one pipeline");
+    CLI11_PARSE(app);
+    if (workers <= 0) {
+        workers = std::thread::hardware_concurrency();
+    }
+    if (batch_size == 0) {
+        batch_size = 1;
+    }
+
+    std::string postgres_uri = "host=" + postgres_host + " " + "dbname=" + postgres_db_name;
+    if (postgres_db_username.size()) {
+        postgres_uri += (" user=" + postgres_db_username);
+    }
+    if (postgres_db_password.size()) {
+        postgres_uri += (" password=" + postgres_db_password);
+    }
+
+    long long min_id = 0;
+    long long max_id = 0;
+    try {
+        pqxx::connection conn(postgres_uri);
+        pqxx::read_transaction txn(conn);
+        pqxx::row result = txn.exec1("SELECT min(id), max(id) FROM " + data_table);
+        if (result[0].is_null()) {
+            std::cout << "rows:0 keys set:0" << std::endl;
+            return 0;
+        }
+        min_id = result[0].as<long long>();
+        max_id = result[1].as<long long>();
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    // rows inserted after min/max were read are not prewarmed, they are cached on their first miss
+    long long range = (max_id - min_id) / workers + 1;
+    for (int worker = 0; worker < workers; worker++) {
+        long long lo = min_id + worker * range;
+        if (lo > max_id) {
+            break;
+        }
+        threads.emplace_back(prewarm_worker, postgres_uri, redis_server, lo, std::min(lo + range, max_id + 1), worker, batch_size);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "rows:" << rows_read << " keys set:" << keys_set << " failed:" << keys_failed << " deleted after recheck:" << keys_deleted << " seconds:" << elapsed << std::endl;
+    return failed_workers || keys_failed ? 1 : 0;
+}
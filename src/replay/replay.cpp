@@ -0,0 +1,145 @@
+#include <map>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <string_view>
+
+#include "CLI/CLI.hpp"
+
+#include "client.hpp"
+#include "trace.hpp"
+#include "utils.hpp"
+
+std::vector<std::string> speeds = { "original", "max" };
+
+/**
+ * replays the reads and writes of a trace against the caches of the same usernames.
+ * keys are sharded between the threads by hash and every thread walks the whole trace for its shard,
+ * so the operations on one key keep their trace order at any speed.
+ * notifications and invalidation decisions are not replayed, the running invalidator makes them again
+*/
+int replay(const std::string &trace_path, std::map<std::string, std::unique_ptr<Client>> &clients, bool original_speed, int threads_number)
+{
+    std::atomic<int> errors{0};
+    std::atomic<long long> reads{0};
+    std::atomic<long long> writes{0};
+    std::atomic<long long> ignored{0};
+    auto start = std::chrono::steady_clock::now();
+    auto replay_shard = [&](int shard) {
+        try {
+            TraceReader reader(trace_path);
+            uint64_t first_ts = 0;
+            TraceRecord record;
+            while (reader.next(record)) {
+                if (record.event != TraceEvent::read_hit && record.event != TraceEvent::read_miss && record.event != TraceEvent::write) {
+                    continue;
+                }
+                auto iter = clients.find(std::string(record.node));
+                if (iter == clients.end()) {
+                    if (shard == 0) {
+                        ignored++;
+                    }
+                    continue;
+                }
+                // the first replayed record of the whole trace, the same for every shard
+                if (first_ts == 0) {
+                    first_ts = record.timestamp_ns;
+                }
+                if (std::hash<std::string_view>{}(record.key) % threads_number != static_cast<size_t>(shard)) {
+                    continue;
+                }
+                if (original_speed) {
+                    std::this_thread::sleep_until(start + std::chrono::nanoseconds(record.timestamp_ns - first_ts));
+                }
+                std::string key(record.key);
+                try {
+                    if (record.event == TraceEvent::write) {
+                        writes++;
+                        iter->second->change_key(key);
+                    } else {
+                        reads++;
+                        iter->second->read_key(key);
+                    }
+                } catch (const std::exception &e) {
+                    errors++;
+                }
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            errors++;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int shard = 0; shard < threads_number; shard++) {
+        threads.emplace_back(replay_shard, shard);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int hits = 0;
+    int misses = 0;
+    for (auto &[username, client] : clients) {
+        hits += client->get_hits();
+        misses += client->get_misses();
+    }
+    std::cout << "reads:" << reads << " writes:" << writes << " ignored:" << ignored << " errors:" << errors <<
+        " seconds:" << elapsed << " ops/s:" << (elapsed > 0 ? (reads + writes) / elapsed : 0.0) << std::endl;
+    std::cout << "hits:" << hits << " hit rate:" <<
+        (hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0) << std::endl;
+    return errors ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    CLI::App app{"Consistant cache trace replay"};
+    std::string footer = std::string("Example:\n") + argv[0] + " --trace stress.trace --speed max --postgres-host 192.168.0.1 --postgres-db-name my_db --postgres-db-usernames-passwords username1:password1,username2:password2 --redis-servers username1@127.0.0.1:6379,username2@127.0.0.1:6380";
+    app.footer(footer);
+    std::string trace_path;
+    std::string speed = "max";
+    std::string postgres_host;
+    std::string postgres_db_name;
+    std::vector<std::string> post_db_usernames_passwords;
+    std::string redis_str;
+    int threads_number = 0;
+    app.add_option("--trace", trace_path, "binary trace file to replay")->required();
+    app.add_option("--speed", speed, "replay at the original timing or as fast as possible")->check(CLI::IsMember(speeds));
+    app.add_option("--postgres-host", postgres_host, "PostgresDB host name")->required();
+    app.add_option("--postgres-db-name", postgres_db_name, "PostgresDB database name")->required();
+    app.add_option("--postgres-db-usernames-passwords", post_db_usernames_passwords, "comma separeted list of PostgresDB username:password")->required()->delimiter(',');
+    app.add_option("--redis-servers", redis_str, "comma separated list of \"username@redis_server_ip:port\"")->required();
+    app.add_option("-t, --threads", threads_number, "number of threads replaying operations, every key is replayed by one thread");
+    CLI11_PARSE(app);
+    if (threads_number == 0) {
+        threads_number = std::thread::hardware_concurrency();
+    }
+
+    std::map<std::string, std::string> postgres_uris;
+    for (const auto& post_db_usernames_password: post_db_usernames_passwords) {
+        size_t pos = post_db_usernames_password.find(":");
+        if (pos == std::string::npos) {
+            std::cerr << "Colon not found! in post-db-usernames-passwords" << std::endl;
+            return -1;
+        }
+        auto user = post_db_usernames_password.substr(0, pos);
+        auto pass = post_db_usernames_password.substr(pos + 1);
+        postgres_uris.emplace(user, "host=" + postgres_host + " dbname=" + postgres_db_name + " user=" + user + " password=" + pass);
+    }
+    try {
+        // fail early on a missing or invalid trace, every thread maps its own reader
+        TraceReader reader(trace_path);
+        std::map<std::string, std::unique_ptr<Client>> clients;
+        for (const auto& [username, conn] : parse_redis_data(redis_str)) {
+            clients.emplace(username, std::make_unique<Client>(postgres_uris[username], conn));
+        }
+        return replay(trace_path, clients, speed == "original", threads_number);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
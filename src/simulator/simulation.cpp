@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <queue>
+
+#include "invalidation.hpp"
+#include "simulation.hpp"
+
+// Client::read_param only caches values that live at least this long
+const double min_cache_time_ms = 50;
+
+static std::chrono::system_clock::time_point to_time_point(double ms)
+{
+    return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::duration<double, std::milli>(ms)));
+}
+
+void SimulationResult::print(std::ostream& out) const
+{
+    double hit_ratio = reads ? static_cast<double>(hits) / reads : 0.0;
+    double saved = saved_no_readers + saved_not_read + saved_expired;
+    out << "events:" << events << " seconds:" << wall_sec << " events/s:" << (wall_sec > 0 ? events / wall_sec : 0.0) << std::endl;
+    out << "reads:" << reads << " hits:" << hits << " hit ratio:" << hit_ratio << std::endl;
+    out << "stale reads:" << stale_reads << " mean staleness ms:" << (stale_reads ? staleness_sum_ms / stale_reads : 0.0) <<
+        " max staleness ms:" << staleness_max_ms << std::endl;
+    out << "writes:" << writes << " notifications:" << notifications << " merged:" << merged << " ttl updates:" << ttl_updates << std::endl;
+    out << "total queries:" << total_queries << " invalidations sent:" << invalidations_sent << " saved queries:" << saved <<
+        " (no readers:" << saved_no_readers << " not read:" << saved_not_read << " expired:" << saved_expired << ")" << std::endl;
+    out << "invalidations per read:" << (reads ? static_cast<double>(invalidations_sent) / reads : 0.0) <<
+        " per cached value:" << (fills ? static_cast<double>(invalidations_sent) / fills : 0.0) << std::endl;
+}
+
+Simulation::Simulation(const SimulationConfig& config) :
+    config_(config),
+    gen_(config.seed),
+    keys_(config.keys),
+    entries_(static_cast<size_t>(config.caches) * config.keys),
+    read_log_(static_cast<size_t>(config.caches) * config.keys, no_read)
+{
+    double sum = 0;
+    key_cdf_.reserve(config_.keys);
+    key_names_.reserve(config_.keys);
+    for (int i = 0; i < config_.keys; i++) {
+        sum += 1.0 / std::pow(i + 1, config_.zipf);
+        key_cdf_.push_back(sum);
+        key_names_.push_back(std::string("Parameter_") + std::to_string(i));
+    }
+    for (auto& p : key_cdf_) {
+        p /= sum;
+    }
+    std::uniform_real_distribution<> clock_dist(-config_.clock_error_ms, config_.clock_error_ms);
+    for (int i = 0; i < config_.caches; i++) {
+        clock_errors_ms_.push_back(config_.clock_error_ms > 0 ? clock_dist(gen_) : 0.0);
+    }
+    std::uniform_real_distribution<> jitter_dist(0, config_.ttl_jitter_ms);
+    for (auto& key : keys_) {
+        key.ttl_ms = config_.ttl_ms + (config_.ttl_jitter_ms > 0 ? jitter_dist(gen_) : 0.0);
+    }
+    if (config_.ttl_tuning) {
+        tuner_ = std::make_unique<TtlTuner>(*config_.ttl_tuning);
+    }
+}
+
+int Simulation::pick_key()
+{
+    double p = std::uniform_real_distribution<>(0, 1)(gen_);
+    auto iter = std::lower_bound(key_cdf_.begin(), key_cdf_.end(), p);
+    return std::min<int>(iter - key_cdf_.begin(), config_.keys - 1);
+}
+
+/*
+ * same as Client::read_param, the cache keeps the value until the end of life computed with its own clock
+*/
+void Simulation::read(double now_ms, int cache, int key)
+{
+    result_.reads++;
+    auto& state = keys_[key];
+    auto& entry = entries_[static_cast<size_t>(cache) * config_.keys + key];
+    if (entry.version >= 0 && entry.expiry_ms > now_ms) {
+        result_.hits++;
+        if (entry.version != state.version) {
+            double staleness_ms = now_ms - entry.stale_since_ms;
+            result_.stale_reads++;
+            result_.staleness_sum_ms += staleness_ms;
+            result_.staleness_max_ms = std::max(result_.staleness_max_ms, staleness_ms);
+        }
+        return;
+    }
+    entry.version = -1;
+    read_log_[static_cast<size_t>(cache) * config_.keys + key] = state.write_time_ms;
+    double eol_ms = state.write_time_ms + state.ttl_ms;
+    double cache_now_ms = now_ms + clock_errors_ms_[cache];
+    if (eol_ms > cache_now_ms + min_cache_time_ms) {
+        entry.version = state.version;
+        entry.expiry_ms = now_ms + (eol_ms - cache_now_ms);
+        result_.fills++;
+    }
+}
+
+/*
+ * same as Client::change_param, the writer drops its own copy and the trigger notifies the invalidator
+*/
+void Simulation::write(double now_ms, int cache, int key)
+{
+    result_.writes++;
+    result_.notifications++;
+    auto& state = keys_[key];
+    // copies of the version being replaced become stale now, older copies already are
+    for (int c = 0; c < config_.caches; c++) {
+        auto& entry = entries_[static_cast<size_t>(c) * config_.keys + key];
+        if (entry.version == state.version) {
+            entry.stale_since_ms = now_ms;
+        }
+    }
+    state.version++;
+    state.write_time_ms = now_ms;
+    entries_[static_cast<size_t>(cache) * config_.keys + key].version = -1;
+    if (tuner_) {
+        tuner_->record_write(key_names_[key], to_time_point(now_ms));
+    }
+    if (state.pending) {
+        result_.merged++;
+    }
+}
+
+/*
+ * same as NotificationHandler::invalidate
+*/
+void Simulation::notification(double now_ms, int key)
+{
+    auto& state = keys_[key];
+    state.pending = false;
+    bool has_readers = false;
+    for (int cache = 0; cache < config_.caches; cache++) {
+        has_readers |= read_log_[static_cast<size_t>(cache) * config_.keys + key] != no_read;
+    }
+    if (!has_readers) {
+        result_.saved_no_readers++;
+        return;
+    }
+    auto now = to_time_point(now_ms);
+    auto uncertainty = std::chrono::milliseconds((long long)config_.uncertainty_ms);
+    for (int cache = 0; cache < config_.caches; cache++) {
+        size_t idx = static_cast<size_t>(cache) * config_.keys + key;
+        result_.total_queries++;
+        bool was_read = read_log_[idx] != no_read;
+        // read_log keeps the write time of the value the cache got, like value_timestamp in tables.sql
+        auto param_eol_time = param_end_of_life(to_time_point(was_read ? read_log_[idx] : 0), state.ttl_ms);
+        switch (decide_invalidation(was_read, now, param_eol_time, uncertainty)) {
+        case InvalidationDecision::invalidate:
+            result_.invalidations_sent++;
+            entries_[idx].version = -1;
+            break;
+        case InvalidationDecision::not_read:
+            result_.saved_not_read++;
+            break;
+        case InvalidationDecision::expired:
+            result_.saved_expired++;
+            break;
+        }
+        read_log_[idx] = no_read;
+    }
+}
+
+/*
+ * same rule as NotificationHandler::tune_ttls, a TTL is only lowered once it expired
+*/
+void Simulation::tune(double now_ms)
+{
+    auto now = to_time_point(now_ms);
+    for (int key = 0; key < config_.keys; key++) {
+        auto& state = keys_[key];
+        auto next_ttl_ms = tuner_->next_ttl(key_names_[key], state.ttl_ms, now);
+        if (!next_ttl_ms || std::abs(*next_ttl_ms - state.ttl_ms) < 1.0) {
+            continue;
+        }
+        bool expired = state.write_time_ms + state.ttl_ms < now_ms - config_.uncertainty_ms;
+        if (*next_ttl_ms >= state.ttl_ms || expired) {
+            state.ttl_ms = *next_ttl_ms;
+            result_.ttl_updates++;
+        }
+    }
+}
+
+SimulationResult Simulation::run()
+{
+    auto start = std::chrono::steady_clock::now();
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    double end_ms = config_.duration_sec * 1000;
+    double rate_per_ms = (config_.reads_per_sec + config_.writes_per_sec) / 1000;
+    double read_share = config_.reads_per_sec / (config_.reads_per_sec + config_.writes_per_sec);
+    std::exponential_distribution<> arrival_dist(rate_per_ms);
+    std::uniform_real_distribution<> op_dist(0, 1);
+    std::uniform_int_distribution<> cache_dist(0, config_.caches - 1);
+    if (tuner_) {
+        events.push({config_.tune_interval_sec * 1000, EventType::tune, 0});
+    }
+
+    double next_arrival_ms = arrival_dist(gen_);
+    while (true) {
+        bool arrival = next_arrival_ms <= end_ms && (events.empty() || next_arrival_ms < events.top().time_ms);
+        if (!arrival && (events.empty() || events.top().time_ms > end_ms)) {
+            break;
+        }
+        result_.events++;
+        if (arrival) {
+            double now_ms = next_arrival_ms;
+            next_arrival_ms += arrival_dist(gen_);
+            int key = pick_key();
+            int cache = cache_dist(gen_);
+            if (op_dist(gen_) < read_share) {
+                read(now_ms, cache, key);
+                continue;
+            }
+            bool pending = keys_[key].pending;
+            write(now_ms, cache, key);
+            if (!pending) {
+                keys_[key].pending = true;
+                events.push({now_ms + config_.notify_delay_ms, EventType::notification, key});
+            }
+            continue;
+        }
+        Event event = events.top();
+        events.pop();
+        if (event.type == EventType::notification) {
+            notification(event.time_ms, event.key);
+        } else {
+            tune(event.time_ms);
+            events.push({event.time_ms + config_.tune_interval_sec * 1000, EventType::tune, 0});
+        }
+    }
+    result_.wall_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result_;
+}
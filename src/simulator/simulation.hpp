@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <random>
+#include <memory>
+#include <ostream>
+#include <optional>
+
+#include "ttl_tuner.hpp"
+
+/**
+ * discrete event model of the caches, the database and the invalidator, all times are in simulated ms.
+ * reads and writes arrive as poisson processes over zipf distributed keys, caches fill and expire
+ * the way Client does and notifications are decided with the invalidator's decision code
+*/
+struct SimulationConfig {
+    int caches = 4;
+    int keys = 1000;
+    double zipf = 1.0;
+    double reads_per_sec = 10000;
+    double writes_per_sec = 100;
+    double duration_sec = 3600;
+    double ttl_ms = 6000;
+    double ttl_jitter_ms = 1000;        // initial TTLs are ttl_ms plus up to this, like populate_db
+    double clock_error_ms = 0;          // every cache clock is off by up to this in either direction
+    double notify_delay_ms = 5;         // from a write until the invalidator handles its notification
+    double uncertainty_ms = 500;        // time uncertainty used by the invalidator
+    std::optional<TtlTuner::Config> ttl_tuning;
+    double tune_interval_sec = 10;
+    unsigned seed = 1;
+};
+
+struct SimulationResult {
+    long long events = 0;
+    long long reads = 0;
+    long long hits = 0;
+    long long fills = 0;                // misses that cached the value
+    long long stale_reads = 0;
+    double staleness_sum_ms = 0;
+    double staleness_max_ms = 0;
+    long long writes = 0;
+    long long notifications = 0;
+    long long merged = 0;
+    long long total_queries = 0;
+    long long invalidations_sent = 0;
+    long long saved_no_readers = 0;
+    long long saved_not_read = 0;
+    long long saved_expired = 0;
+    long long ttl_updates = 0;
+    double wall_sec = 0;
+    void print(std::ostream& out) const;
+};
+
+class Simulation
+{
+    struct CacheEntry {
+        long long version = -1;
+        double expiry_ms = 0;
+        double stale_since_ms = 0;          // when a newer version was written, valid once version is old
+    };
+    struct KeyState {
+        long long version = 0;
+        double ttl_ms = 0;
+        double write_time_ms = 0;
+        bool pending = false;
+    };
+    enum class EventType { notification, tune };
+    struct Event {
+        double time_ms;
+        EventType type;
+        int key;
+        bool operator>(const Event& other) const { return time_ms > other.time_ms; }
+    };
+
+    static constexpr double no_read = -1;
+
+    SimulationConfig config_;
+    std::mt19937_64 gen_;
+    std::vector<double> key_cdf_;
+    std::vector<std::string> key_names_;
+    std::vector<double> clock_errors_ms_;
+    std::vector<KeyState> keys_;
+    std::vector<CacheEntry> entries_;       // caches x keys
+    std::vector<double> read_log_;          // caches x keys, write time of the value last read or no_read
+    std::unique_ptr<TtlTuner> tuner_;
+    SimulationResult result_;
+public:
+    explicit Simulation(const SimulationConfig& config);
+    SimulationResult run();
+private:
+    int pick_key();
+    void read(double now_ms, int cache, int key);
+    void write(double now_ms, int cache, int key);
+    void notification(double now_ms, int key);
+    void tune(double now_ms);
+};
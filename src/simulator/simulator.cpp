@@ -0,0 +1,49 @@
+#include <iostream>
+#include <string>
+
+#include "CLI/CLI.hpp"
+
+#include "simulation.hpp"
+
+int main(int argc, char* argv[]) {
+    CLI::App app{"Consistant cache invalidation simulator"};
+    std::string footer = std::string("Example:\n") + argv[0] + " --caches 6 --keys 10000 --read-rate 50000 --write-rate 500 --duration 600 --ttl-ms 6000 --clock-error-ms 2";
+    app.footer(footer);
+    SimulationConfig config;
+    TtlTuner::Config ttl_config;
+    double ttl_target = 0;
+    app.add_option("--caches", config.caches, "number of Redis caches");
+    app.add_option("--keys", config.keys, "number of parameters");
+    app.add_option("--zipf", config.zipf, "zipf exponent of the key popularity, 0 is uniform");
+    app.add_option("--read-rate", config.reads_per_sec, "reads per simulated second over all caches");
+    app.add_option("--write-rate", config.writes_per_sec, "writes per simulated second over all caches");
+    app.add_option("--duration", config.duration_sec, "simulated seconds");
+    app.add_option("--ttl-ms", config.ttl_ms, "initial TTL of every parameter");
+    app.add_option("--ttl-jitter-ms", config.ttl_jitter_ms, "initial TTLs are spread uniformly up to this above --ttl-ms");
+    app.add_option("--clock-error-ms", config.clock_error_ms, "largest clock error of a cache in either direction");
+    app.add_option("--notify-delay-ms", config.notify_delay_ms, "time from a write until the invalidator handles it");
+    app.add_option("--uncertainty-ms", config.uncertainty_ms, "time uncertainty used by the invalidator");
+    app.add_option("--ttl-target", ttl_target, "tune TTLs for this expected number of invalidations per cached value, 0 keeps TTLs static");
+    app.add_option("--ttl-tune-interval", config.tune_interval_sec, "simulated seconds between TTL tuning rounds");
+    app.add_option("--ttl-min-ms", ttl_config.min_ttl_ms, "lowest TTL the tuner assigns");
+    app.add_option("--ttl-max-ms", ttl_config.max_ttl_ms, "highest TTL the tuner assigns");
+    app.add_option("--seed", config.seed, "random seed");
+    CLI11_PARSE(app);
+
+    if (config.caches <= 0 || config.keys <= 0 || config.reads_per_sec + config.writes_per_sec <= 0) {
+        std::cerr << "caches, keys and read or write rate must be positive" << std::endl;
+        return 1;
+    }
+    double min_safe_ttl_ms = config.uncertainty_ms + config.notify_delay_ms;
+    if (ttl_target > 0 && ttl_config.min_ttl_ms < min_safe_ttl_ms) {
+        std::cerr << "--ttl-min-ms raised to " << min_safe_ttl_ms << ", a lower TTL is inside the invalidation uncertainty" << std::endl;
+        ttl_config.min_ttl_ms = min_safe_ttl_ms;
+    }
+    if (ttl_target > 0) {
+        ttl_config.target_invalidations = ttl_target;
+        config.ttl_tuning = ttl_config;
+    }
+    Simulation simulation(config);
+    simulation.run().print(std::cout);
+    return 0;
+}
@@ -27,10 +27,46 @@ std::atomic<int> counter;
 
 Client::Client(std::string postgres_uri, std::string redis_ip):
     postgres_(postgres_uri),
-    redis_("tcp://" + redis_ip),
-    ip_port_(redis_ip)
+    ip_port_(redis_ip),
+    hits_(0),
+    misses_(0),
+    trace_(nullptr)
 {
-    // Constructor code if needed
+    const std::string cluster_prefix = "cluster:";
+    if (redis_ip.compare(0, cluster_prefix.size(), cluster_prefix) == 0) {
+        ip_port_ = redis_ip.substr(cluster_prefix.size());
+        cluster_ = std::make_unique<sw::redis::RedisCluster>("tcp://" + ip_port_);
+        nodes_ = cluster_nodes();
+    } else {
+        redis_ = std::make_unique<sw::redis::Redis>("tcp://" + redis_ip);
+        nodes_ = {redis_ip};
+    }
+}
+
+/**
+ * the masters of the cluster from CLUSTER NODES of the seed node, lines look like
+ * "<id> <ip:port@cport> <flags> ..."
+*/
+std::vector<std::string> Client::cluster_nodes()
+{
+    sw::redis::Redis seed("tcp://" + ip_port_);
+    std::istringstream stream(seed.command<std::string>("CLUSTER", "NODES"));
+    std::vector<std::string> nodes;
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::istringstream fields(line);
+        std::string id, address, flags;
+        if (!(fields >> id >> address >> flags) || flags.find("master") == std::string::npos) {
+            continue;
+        }
+        address = address.substr(0, address.find('@'));
+        // a node that does not know its own ip yet reports ":port"
+        if (address.front() == ':') {
+            address = ip() + address;
+        }
+        nodes.push_back(address);
+    }
+    return nodes;
 }
 
 // Client::~Client()
@@ -49,31 +85,40 @@ std::string Client::ip()
     return ip_port_.substr(0, pos);
 }
 
+/**
+ * runs redis-cli MONITOR on every node of the cache, on a cluster a key is deleted on the node owning it
+*/
 void Client::start_monitor()
 {
     std::string cmd = "/usr/bin/redis-cli";
-    std::vector<std::string> args = { "/usr/bin/redis-cli", "-h", ip(), "MONITOR"};
-    pr = std::make_unique<ProcessRunner>(cmd, args);
-    pr->start();
+    monitors_.clear();
+    for (const auto &node : nodes_) {
+        size_t pos = node.rfind(':');
+        std::vector<std::string> args = { "/usr/bin/redis-cli", "-h", node.substr(0, pos), "-p", node.substr(pos + 1), "MONITOR"};
+        monitors_.push_back(std::make_unique<ProcessRunner>(cmd, args));
+        monitors_.back()->start();
+    }
 }
 
 std::vector<std::string> Client::get_exp_deleted_keys()
 {
 std::vector<std::string> extractedParams;
-    std::istringstream stream(pr->get_output());
-    std::string line;
+    for (auto &monitor : monitors_) {
+        std::istringstream stream(monitor->get_output());
+        std::string line;
 
-    while (std::getline(stream, line)) {
-        if (line.find("DEL") != std::string::npos) {
-            std::istringstream iss(line);
-            std::string word;
-            std::string lastWord;
+        while (std::getline(stream, line)) {
+            if (line.find("DEL") != std::string::npos) {
+                std::istringstream iss(line);
+                std::string word;
+                std::string lastWord;
 
-            while (iss >> std::quoted(word)) {
-                lastWord = word;
-            }
+                while (iss >> std::quoted(word)) {
+                    lastWord = word;
+                }
 
-            extractedParams.push_back(lastWord);
+                extractedParams.push_back(lastWord);
+            }
         }
     }
 
@@ -82,13 +127,25 @@ std::vector<std::string> extractedParams;
 
 void Client::stop_monitor()
 {
-    pr->stop();
+    for (auto &monitor : monitors_) {
+        monitor->stop();
+    }
+}
+
+void Client::set_trace(TraceWriter* trace, const std::string& node)
+{
+    trace_ = trace;
+    node_ = node;
 }
 
 void Client::change_param(int idx)
+{
+    change_key(param(idx));
+}
+
+void Client::change_key(const std::string& parameter)
 {
     auto value = next_value();
-    auto parameter = param(idx);
     std::string query = "UPDATE " + data_table +  " SET parameter_value = $1, timestamp=NOW() WHERE parameter_name = $2";
     {
         std::lock_guard<std::mutex> lock(db_lock_);
@@ -96,7 +153,10 @@ void Client::change_param(int idx)
         txn.exec_params(query, value, parameter);
         txn.commit();
     }
-    redis_.del(parameter);
+    with_redis([&](auto &redis) { return redis.del(parameter); });
+    if (trace_) {
+        trace_->record(TraceEvent::write, node_, parameter);
+    }
 }
 
 void Client::change_params(std::vector<int> idxs)
@@ -121,7 +181,10 @@ void Client::change_params(std::vector<int> idxs)
     }
     for (const auto idx : idxs) {
         auto parameter = param(idx);
-        redis_.del(parameter);
+        with_redis([&](auto &redis) { return redis.del(parameter); });
+        if (trace_) {
+            trace_->record(TraceEvent::write, node_, parameter);
+        }
     }
 }
 
@@ -143,13 +206,22 @@ void Client::debug_params_table()
 */
 std::string Client::read_param(int idx)
 {
-    auto parameter = param(idx);
+    return read_key(param(idx));
+}
+
+std::string Client::read_key(const std::string& parameter)
+{
     {
-        auto val = redis_.get(parameter);
+        auto val = with_redis([&](auto &redis) { return redis.get(parameter); });
         if (val) {
+            hits_++;
+            if (trace_) {
+                trace_->record(TraceEvent::read_hit, node_, parameter);
+            }
             return *val;
         }
     }
+    misses_++;
     pqxx::row result;
     {
         std::lock_guard<std::mutex> lock(db_lock_);
@@ -168,10 +240,14 @@ std::string Client::read_param(int idx)
     // Create a system_clock time_point with milliseconds
     std::chrono::system_clock::time_point param_eol_time = parse_time(timestamp_str) + std::chrono::microseconds((long long)(ttl_ms * 1000));
     auto now = std::chrono::system_clock::now();
+    std::chrono::milliseconds t{0};
     if (param_eol_time > now + std::chrono::milliseconds{50}) {
-        auto t = std::chrono::duration_cast<std::chrono::milliseconds>(param_eol_time - now);
+        t = std::chrono::duration_cast<std::chrono::milliseconds>(param_eol_time - now);
         // std::cout << "setting key " << parameter << " for another " << t.count() << " ms" << std::endl;
-        redis_.psetex(parameter, t, val);
+        with_redis([&](auto &redis) { redis.psetex(parameter, t, val); });
+    }
+    if (trace_) {
+        trace_->record(TraceEvent::read_miss, node_, parameter, static_cast<uint32_t>(t.count()));
     }
 
     return val;
@@ -195,7 +271,16 @@ void Client::drop_postgres_tables()
 
 void Client::drop_redis_tables()
 {
-    redis_.flushall();
+    if (cluster_) {
+        // FLUSHALL is not routed by the cluster client, every master is flushed on its own
+        for (const auto &node : nodes_) {
+            sw::redis::Redis("tcp://" + node).flushall();
+        }
+    } else {
+        redis_->flushall();
+    }
+    hits_ = 0;
+    misses_ = 0;
 }
 
 void Client::populate_db(int num_of_entries, int ttl)
@@ -6,8 +6,10 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <atomic>
 
 #include "process_runner.hpp"
+#include "trace.hpp"
 #include <pqxx/pqxx>
 #include <sw/redis++/redis++.h>
 
@@ -17,31 +19,50 @@ class Client
 {
 using  redis_keys_deleted = std::vector<std::string>;
     pqxx::connection postgres_;
-    sw::redis::Redis redis_;
+    std::unique_ptr<sw::redis::Redis> redis_;
+    std::unique_ptr<sw::redis::RedisCluster> cluster_; // set when the cache is a "cluster:ip:port" Redis Cluster
     redis_keys_deleted key_states_; // map if ip to redis key status
     std::string ip_port_;
-    std::unique_ptr<ProcessRunner> pr;
+    std::vector<std::string> nodes_; // ip:port of every master of a cluster, or of the standalone server
+    std::vector<std::unique_ptr<ProcessRunner>> monitors_;
     std::mutex db_lock_;
+    std::atomic<int> hits_;
+    std::atomic<int> misses_;
+    TraceWriter* trace_;
+    std::string node_;
 public:
     Client(std::string postgres_uri, std::string redis_ip);
     // ~Client();
     void change_param(int idx);
     void change_params(std::vector<int> idxs);
     std::string read_param(int idx);
+    void change_key(const std::string& parameter);
+    std::string read_key(const std::string& parameter);
+    void set_trace(TraceWriter* trace, const std::string& node);
     void populate_db(int num_of_entries, int ttl=0);
     void clear();
     void start_monitor();
     void stop_monitor();
     std::string ip();
+    std::string address() { return ip_port_; }
     void debug_params_table();
     std::vector<std::string> get_exp_deleted_keys();
-private:
+    int get_hits() { return hits_; }
+    int get_misses() { return misses_; }
     std::string param(int i);
+private:
     std::string value(int i);
     std::string next_param();
     std::string next_value();
     
     void drop_postgres_tables();
     void drop_redis_tables();
+    std::vector<std::string> cluster_nodes();
+
+    template <typename Func>
+    auto with_redis(Func func)
+    {
+        return cluster_ ? func(*cluster_) : func(*redis_);
+    }
 
 };
\ No newline at end of file
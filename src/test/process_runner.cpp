@@ -50,7 +50,12 @@ void ProcessRunner::run_process() {
         close(pipefd[0]); // Close read-end, as we're going to write to it
         dup2(pipefd[1], STDOUT_FILENO); // Redirect stdout to the pipe
         close(pipefd[1]); // This descriptor is no longer needed
-        if (execle(path_.c_str(), args_[0].c_str(), args_[1].c_str(), args_[2].c_str(), args_[3].c_str(), (char*)nullptr, environ) == -1) {
+        std::vector<char*> argv;
+        for (auto &arg : args_) {
+            argv.push_back(arg.data());
+        }
+        argv.push_back(nullptr);
+        if (execve(path_.c_str(), argv.data(), environ) == -1) {
             perror("execl error\n");
         }
         std::cout <<"child failed " << errno;
@@ -0,0 +1,20 @@
+#include "invalidation.hpp"
+
+std::chrono::system_clock::time_point param_end_of_life(std::chrono::system_clock::time_point timestamp, double ttl_ms)
+{
+    return timestamp + std::chrono::microseconds((long long)(ttl_ms * 1000));
+}
+
+InvalidationDecision decide_invalidation(bool was_read, std::chrono::system_clock::time_point now,
+                                         std::chrono::system_clock::time_point param_eol_time,
+                                         std::chrono::milliseconds time_uncertainty)
+{
+    if (!was_read) {
+        return InvalidationDecision::not_read;
+    }
+    // the copy may live until its end of life on a clock that is off by the uncertainty
+    if (now < param_eol_time + time_uncertainty) {
+        return InvalidationDecision::invalidate;
+    }
+    return InvalidationDecision::expired;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <chrono>
+
+/**
+ * the invalidation decision shared by the invalidator and the simulator
+*/
+enum class InvalidationDecision {
+    invalidate,     // the node may still hold the value
+    not_read,       // the node never read the value
+    expired,        // the node read the value but its TTL passed, even with the time uncertainty
+};
+
+/**
+ * end of life of a cached copy of the value written at timestamp
+*/
+std::chrono::system_clock::time_point param_end_of_life(std::chrono::system_clock::time_point timestamp, double ttl_ms);
+
+InvalidationDecision decide_invalidation(bool was_read, std::chrono::system_clock::time_point now,
+                                         std::chrono::system_clock::time_point param_eol_time,
+                                         std::chrono::milliseconds time_uncertainty);
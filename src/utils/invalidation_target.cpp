@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#include "invalidation_target.hpp"
+
+const std::string cluster_prefix = "cluster:";
+// a key is retried at most this many times after MOVED, ASK or a lost connection
+const int max_redirections = 5;
+
+static std::string redis_uri(const std::string& address)
+{
+    return "tcp://" + address + "?keep_alive=true";
+}
+
+StandaloneTarget::StandaloneTarget(const std::string& address) :
+    redis_(redis_uri(address))
+{}
+
+void StandaloneTarget::del(const std::vector<std::string>& keys)
+{
+    if (keys.empty()) {
+        return;
+    }
+    round_trips_++;
+    if (keys.size() == 1) {
+        redis_.del(keys[0]);
+        return;
+    }
+    auto pipe = redis_.pipeline(false);
+    for (const auto& key : keys) {
+        pipe.del(key);
+    }
+    pipe.exec();
+}
+
+sw::redis::OptionalString StandaloneTarget::get(const std::string& key)
+{
+    return redis_.get(key);
+}
+
+ClusterTarget::ClusterTarget(const std::string& seed) :
+    seed_(seed)
+{
+    slots_.fill(no_node);
+    refresh_slots();
+}
+
+/*
+ * CRC16/XMODEM of the key, or of its hash tag when it has a non empty {...}, modulo the slot count
+*/
+uint16_t ClusterTarget::key_slot(std::string_view key)
+{
+    auto open = key.find('{');
+    if (open != std::string_view::npos) {
+        auto close = key.find('}', open + 1);
+        if (close != std::string_view::npos && close != open + 1) {
+            key = key.substr(open + 1, close - open - 1);
+        }
+    }
+    uint16_t crc = 0;
+    for (unsigned char c : key) {
+        crc ^= static_cast<uint16_t>(c) << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+        }
+    }
+    return crc % slot_count;
+}
+
+void ClusterTarget::refresh_slots()
+{
+    // ask the seed first and fall back to the nodes we already know
+    std::vector<std::string> candidates = {seed_};
+    candidates.insert(candidates.end(), node_addresses_.begin(), node_addresses_.end());
+    std::string seed_host = seed_.substr(0, seed_.rfind(':'));
+    for (const auto& candidate : candidates) {
+        sw::redis::ReplyUPtr reply;
+        try {
+            reply = node(candidate).command("CLUSTER", "SLOTS");
+        } catch (const sw::redis::Error& e) {
+            continue;
+        }
+        if (!reply || reply->type != REDIS_REPLY_ARRAY) {
+            continue;
+        }
+        std::array<uint16_t, slot_count> slots;
+        slots.fill(no_node);
+        std::vector<std::string> addresses;
+        for (size_t i = 0; i < reply->elements; i++) {
+            const redisReply* range = reply->element[i];
+            if (range->type != REDIS_REPLY_ARRAY || range->elements < 3) {
+                continue;
+            }
+            const redisReply* master = range->element[2];
+            if (master->type != REDIS_REPLY_ARRAY || master->elements < 2) {
+                continue;
+            }
+            // an empty host means the node we asked
+            std::string host(master->element[0]->str, master->element[0]->len);
+            std::string address = (host.empty() ? seed_host : host) + ":" + std::to_string(master->element[1]->integer);
+            auto iter = std::find(addresses.begin(), addresses.end(), address);
+            uint16_t idx = static_cast<uint16_t>(iter - addresses.begin());
+            if (iter == addresses.end()) {
+                addresses.push_back(address);
+            }
+            for (long long slot = range->element[0]->integer; slot <= range->element[1]->integer && slot < (long long)slot_count; slot++) {
+                slots[slot] = idx;
+            }
+        }
+        slots_ = slots;
+        node_addresses_ = std::move(addresses);
+        return;
+    }
+    throw std::runtime_error("Failed to get the slots of Redis Cluster " + seed_);
+}
+
+const std::string& ClusterTarget::node_address(const std::string& key)
+{
+    uint16_t idx = slots_[key_slot(key)];
+    return idx == no_node ? seed_ : node_addresses_[idx];
+}
+
+sw::redis::Redis& ClusterTarget::node(const std::string& address)
+{
+    auto iter = nodes_.find(address);
+    if (iter == nodes_.end()) {
+        iter = nodes_.emplace(address, std::make_unique<sw::redis::Redis>(redis_uri(address))).first;
+    }
+    return *iter->second;
+}
+
+/*
+ * QueuedReplies::get throws the error of a reply, so every reply is checked on its own.
+ * a MOVED key is resent after the slot map is refreshed, an ASK key goes to the importing node with ASKING.
+ * a lost connection resends the whole batch, the node may have failed over to another master
+*/
+void ClusterTarget::send_batch(sw::redis::Redis& redis, const std::string& address, const std::vector<std::string>& keys, bool asking,
+                               std::vector<std::string>& moved, std::map<std::string, std::vector<std::string>>& asked)
+{
+    round_trips_++;
+    auto pipe = redis.pipeline(false);
+    for (const auto& key : keys) {
+        if (asking) {
+            pipe.command("ASKING");
+        }
+        pipe.del(key);
+    }
+    std::optional<sw::redis::QueuedReplies> replies;
+    try {
+        replies.emplace(pipe.exec());
+    } catch (const sw::redis::IoError& e) {
+        moved.insert(moved.end(), keys.begin(), keys.end());
+        return;
+    } catch (const sw::redis::ClosedError& e) {
+        moved.insert(moved.end(), keys.begin(), keys.end());
+        return;
+    }
+    size_t stride = asking ? 2 : 1;
+    for (size_t i = 0; i < keys.size(); i++) {
+        try {
+            replies->get(i * stride + stride - 1);
+        } catch (const sw::redis::AskError& e) {
+            if (asking) {
+                // the slot moved on while we were asking, try again with a fresh slot map
+                moved.push_back(keys[i]);
+            } else {
+                asked[e.node().host + ":" + std::to_string(e.node().port)].push_back(keys[i]);
+            }
+        } catch (const sw::redis::MovedError& e) {
+            moved.push_back(keys[i]);
+        } catch (const sw::redis::Error& e) {
+            throw std::runtime_error("Failed to delete " + keys[i] + " from " + address + ": " + e.what());
+        }
+    }
+}
+
+void ClusterTarget::send_batches(const std::map<std::string, std::vector<std::string>>& by_node, bool asking,
+                                 std::vector<std::string>& moved, std::map<std::string, std::vector<std::string>>& asked)
+{
+    struct BatchResult {
+        std::vector<std::string> moved;
+        std::map<std::string, std::vector<std::string>> asked;
+        std::exception_ptr error;
+    };
+    std::vector<BatchResult> results(by_node.size());
+    std::vector<std::thread> threads;
+    size_t idx = 0;
+    for (const auto& [address, node_keys] : by_node) {
+        // connections are made here, the threads only use them
+        sw::redis::Redis& redis = node(address);
+        auto send = [this, &redis, &address = address, &node_keys = node_keys, asking](BatchResult& result) {
+            try {
+                send_batch(redis, address, node_keys, asking, result.moved, result.asked);
+            } catch (...) {
+                result.error = std::current_exception();
+            }
+        };
+        if (by_node.size() == 1) {
+            send(results[idx]);
+        } else {
+            threads.emplace_back(send, std::ref(results[idx]));
+        }
+        idx++;
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& result : results) {
+        if (result.error) {
+            std::rethrow_exception(result.error);
+        }
+        moved.insert(moved.end(), result.moved.begin(), result.moved.end());
+        for (auto& [address, node_keys] : result.asked) {
+            auto& keys = asked[address];
+            keys.insert(keys.end(), node_keys.begin(), node_keys.end());
+        }
+    }
+}
+
+void ClusterTarget::del(const std::vector<std::string>& keys)
+{
+    std::vector<std::string> remaining = keys;
+    for (int attempt = 0; attempt <= max_redirections && !remaining.empty(); attempt++) {
+        std::map<std::string, std::vector<std::string>> by_node;
+        for (const auto& key : remaining) {
+            by_node[node_address(key)].push_back(key);
+        }
+        std::vector<std::string> moved;
+        std::map<std::string, std::vector<std::string>> asked;
+        send_batches(by_node, false, moved, asked);
+        // a slot being migrated, the keys that already moved are sent to the importing node
+        std::map<std::string, std::vector<std::string>> unused;
+        send_batches(asked, true, moved, unused);
+        if (!moved.empty()) {
+            refresh_slots();
+        }
+        remaining = std::move(moved);
+    }
+    if (!remaining.empty()) {
+        throw std::runtime_error("Too many redirections or lost connections deleting keys from Redis Cluster " + seed_);
+    }
+}
+
+sw::redis::OptionalString ClusterTarget::get(const std::string& key)
+{
+    return node(node_address(key)).get(key);
+}
+
+std::unique_ptr<InvalidationTarget> make_invalidation_target(const std::string& address)
+{
+    if (address.rfind(cluster_prefix, 0) == 0) {
+        return std::make_unique<ClusterTarget>(address.substr(cluster_prefix.size()));
+    }
+    return std::make_unique<StandaloneTarget>(address);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include <sw/redis++/redis++.h>
+
+/**
+ * a cache the invalidator deletes keys from, a batch of keys costs one round trip per Redis server
+*/
+class InvalidationTarget
+{
+public:
+    virtual ~InvalidationTarget() = default;
+    virtual void del(const std::vector<std::string>& keys) = 0;
+    virtual sw::redis::OptionalString get(const std::string& key) = 0;
+    long long round_trips() const { return round_trips_; }
+protected:
+    std::atomic<long long> round_trips_{0};
+};
+
+class StandaloneTarget : public InvalidationTarget
+{
+    sw::redis::Redis redis_;
+public:
+    explicit StandaloneTarget(const std::string& address);
+    void del(const std::vector<std::string>& keys) override;
+    sw::redis::OptionalString get(const std::string& key) override;
+};
+
+/**
+ * Redis Cluster target, keys are grouped by the node owning their hash slot and every node gets
+ * one pipeline, the pipelines of all nodes are sent in parallel. the slot map is cached and refreshed
+ * with CLUSTER SLOTS on MOVED, ASK or a lost connection
+*/
+class ClusterTarget : public InvalidationTarget
+{
+    static const size_t slot_count = 16384;
+    static const uint16_t no_node = UINT16_MAX;
+    std::string seed_;
+    std::array<uint16_t, slot_count> slots_;
+    std::vector<std::string> node_addresses_;
+    std::map<std::string, std::unique_ptr<sw::redis::Redis>> nodes_;
+public:
+    explicit ClusterTarget(const std::string& seed);
+    void del(const std::vector<std::string>& keys) override;
+    sw::redis::OptionalString get(const std::string& key) override;
+    static uint16_t key_slot(std::string_view key);
+private:
+    void refresh_slots();
+    const std::string& node_address(const std::string& key);
+    sw::redis::Redis& node(const std::string& address);
+    void send_batches(const std::map<std::string, std::vector<std::string>>& by_node, bool asking,
+                      std::vector<std::string>& moved, std::map<std::string, std::vector<std::string>>& asked);
+    void send_batch(sw::redis::Redis& redis, const std::string& address, const std::vector<std::string>& keys, bool asking,
+                    std::vector<std::string>& moved, std::map<std::string, std::vector<std::string>>& asked);
+};
+
+/**
+ * "cluster:host:port" is a Redis Cluster seed node, anything else a standalone server
+*/
+std::unique_ptr<InvalidationTarget> make_invalidation_target(const std::string& address);
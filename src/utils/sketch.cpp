@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "sketch.hpp"
+
+static uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+CountMinSketch::CountMinSketch(size_t width, size_t depth) :
+    width_(width),
+    depth_(depth),
+    counters_(new std::atomic<uint64_t>[width * depth])
+{
+    for (size_t i = 0; i < width_ * depth_; i++) {
+        counters_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+/*
+ * rows use h1 + row * h2 so the key is only hashed once
+*/
+size_t CountMinSketch::index(uint64_t hash, size_t row) const
+{
+    uint64_t h2 = mix64(hash) | 1;
+    return row * width_ + (hash + row * h2) % width_;
+}
+
+uint64_t CountMinSketch::add(const std::string& key, uint64_t count)
+{
+    uint64_t hash = std::hash<std::string>{}(key);
+    uint64_t estimate = std::numeric_limits<uint64_t>::max();
+    for (size_t row = 0; row < depth_; row++) {
+        uint64_t value = counters_[index(hash, row)].fetch_add(count, std::memory_order_relaxed) + count;
+        estimate = std::min(estimate, value);
+    }
+    return estimate;
+}
+
+uint64_t CountMinSketch::estimate(const std::string& key) const
+{
+    uint64_t hash = std::hash<std::string>{}(key);
+    uint64_t estimate = std::numeric_limits<uint64_t>::max();
+    for (size_t row = 0; row < depth_; row++) {
+        estimate = std::min(estimate, counters_[index(hash, row)].load(std::memory_order_relaxed));
+    }
+    return estimate;
+}
+
+void CountMinSketch::halve()
+{
+    // subtract instead of store so increments racing with the halving are kept
+    for (size_t i = 0; i < width_ * depth_; i++) {
+        uint64_t value = counters_[i].load(std::memory_order_relaxed);
+        counters_[i].fetch_sub(value / 2, std::memory_order_relaxed);
+    }
+}
+
+TopK::TopK(size_t k) :
+    k_(k),
+    min_count_(0)
+{
+    heap_.reserve(k);
+}
+
+void TopK::offer(const std::string& key, uint64_t estimate)
+{
+    if (k_ == 0 || estimate <= min_count_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(lock_, std::try_to_lock);
+    if (!lock) {
+        return;
+    }
+    auto greater = [](const auto& a, const auto& b) { return a.first > b.first; };
+    auto iter = std::find_if(heap_.begin(), heap_.end(), [&key](const auto& elem) { return elem.second == key; });
+    if (iter != heap_.end()) {
+        iter->first = std::max(iter->first, estimate);
+        std::make_heap(heap_.begin(), heap_.end(), greater);
+    } else if (heap_.size() < k_) {
+        heap_.emplace_back(estimate, key);
+        std::push_heap(heap_.begin(), heap_.end(), greater);
+    } else if (estimate > heap_.front().first) {
+        std::pop_heap(heap_.begin(), heap_.end(), greater);
+        heap_.back() = {estimate, key};
+        std::push_heap(heap_.begin(), heap_.end(), greater);
+    }
+    if (heap_.size() == k_) {
+        min_count_.store(heap_.front().first, std::memory_order_relaxed);
+    }
+}
+
+std::vector<std::pair<uint64_t, std::string>> TopK::top()
+{
+    std::vector<std::pair<uint64_t, std::string>> result;
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        result = heap_;
+    }
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    return result;
+}
+
+void TopK::halve()
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    for (auto& elem : heap_) {
+        elem.first /= 2;
+    }
+    min_count_.store(heap_.size() == k_ ? heap_.front().first : 0, std::memory_order_relaxed);
+}
+
+HeavyHitters::HeavyHitters(size_t width, size_t depth, size_t k) :
+    sketch_(width, depth),
+    top_(k),
+    total_(0)
+{}
+
+void HeavyHitters::add(const std::string& key, uint64_t count)
+{
+    total_.fetch_add(count, std::memory_order_relaxed);
+    top_.offer(key, sketch_.add(key, count));
+}
+
+void HeavyHitters::dump(std::ostream& out, const std::string& name)
+{
+    out << name << " total:" << total_.load(std::memory_order_relaxed) << " top:";
+    bool first = true;
+    for (const auto& [count, key] : top_.top()) {
+        out << (first ? "" : ",") << key << "=" << count;
+        first = false;
+    }
+    out << std::endl;
+}
+
+void HeavyHitters::halve()
+{
+    sketch_.halve();
+    top_.halve();
+    uint64_t total = total_.load(std::memory_order_relaxed);
+    total_.fetch_sub(total / 2, std::memory_order_relaxed);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * count-min sketch with atomic counters, any number of threads may add and estimate.
+ * halve() ages the counts so the sketch follows the recent window instead of all time
+*/
+class CountMinSketch
+{
+    size_t width_;
+    size_t depth_;
+    std::unique_ptr<std::atomic<uint64_t>[]> counters_;
+public:
+    CountMinSketch(size_t width, size_t depth);
+    // adds count to key and returns its new estimate
+    uint64_t add(const std::string& key, uint64_t count = 1);
+    uint64_t estimate(const std::string& key) const;
+    void halve();
+private:
+    size_t index(uint64_t hash, size_t row) const;
+};
+
+/**
+ * keeps the k keys with the largest estimates seen so far.
+ * offers below the current minimum return without locking, contended offers are dropped
+ * since a heavy key will be offered again on its next update
+*/
+class TopK
+{
+    size_t k_;
+    std::mutex lock_;
+    std::vector<std::pair<uint64_t, std::string>> heap_; // min heap on the count
+    std::atomic<uint64_t> min_count_;
+public:
+    explicit TopK(size_t k);
+    void offer(const std::string& key, uint64_t estimate);
+    // largest first
+    std::vector<std::pair<uint64_t, std::string>> top();
+    void halve();
+};
+
+/**
+ * constant memory heavy hitters: a count-min sketch for the counts and a top-k for the keys
+*/
+class HeavyHitters
+{
+    CountMinSketch sketch_;
+    TopK top_;
+    std::atomic<uint64_t> total_;
+public:
+    HeavyHitters(size_t width, size_t depth, size_t k);
+    void add(const std::string& key, uint64_t count = 1);
+    // name total:N top:key=count,key=count
+    void dump(std::ostream& out, const std::string& name);
+    // halves every count, called after each dump so old heavy hitters fade out
+    void halve();
+};
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trace.hpp"
+
+const size_t trace_buffer_size = 1 << 16;
+
+static bool write_all(int fd, const char* data, size_t size)
+{
+    while (size) {
+        ssize_t written = write(fd, data, size);
+        if (written == -1) {
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+/*
+ * the file is locked while checking if it is empty so only the first process writes the magic
+*/
+TraceWriter::TraceWriter(const std::string& path) :
+    fd_(open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644))
+{
+    if (fd_ == -1) {
+        throw std::runtime_error("Failed to open trace file " + path);
+    }
+    flock(fd_, LOCK_EX);
+    struct stat st;
+    bool ok = fstat(fd_, &st) == 0 && (st.st_size != 0 || write_all(fd_, trace_magic, sizeof(trace_magic)));
+    flock(fd_, LOCK_UN);
+    if (!ok) {
+        close(fd_);
+        throw std::runtime_error("Failed to write trace file " + path);
+    }
+    buffer_.reserve(trace_buffer_size);
+}
+
+TraceWriter::~TraceWriter()
+{
+    flush();
+    close(fd_);
+}
+
+void TraceWriter::record(TraceEvent event, std::string_view node, std::string_view key, uint32_t arg)
+{
+    TraceRecordHeader header;
+    header.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    header.arg = arg;
+    header.key_len = static_cast<uint16_t>(std::min<size_t>(key.size(), UINT16_MAX));
+    header.node_len = static_cast<uint8_t>(std::min<size_t>(node.size(), UINT8_MAX));
+    header.event = static_cast<uint8_t>(event);
+
+    std::lock_guard<std::mutex> lock(lock_);
+    const char* header_bytes = reinterpret_cast<const char*>(&header);
+    buffer_.insert(buffer_.end(), header_bytes, header_bytes + sizeof(header));
+    buffer_.insert(buffer_.end(), node.data(), node.data() + header.node_len);
+    buffer_.insert(buffer_.end(), key.data(), key.data() + header.key_len);
+    if (buffer_.size() >= trace_buffer_size) {
+        flush_locked();
+    }
+}
+
+void TraceWriter::flush()
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    flush_locked();
+}
+
+void TraceWriter::flush_locked()
+{
+    if (buffer_.empty()) {
+        return;
+    }
+    flock(fd_, LOCK_EX);
+    write_all(fd_, buffer_.data(), buffer_.size());
+    flock(fd_, LOCK_UN);
+    buffer_.clear();
+}
+
+TraceReader::TraceReader(const std::string& path) :
+    data_(nullptr),
+    size_(0),
+    offset_(sizeof(trace_magic))
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open trace file " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(trace_magic)) {
+        close(fd);
+        throw std::runtime_error("Invalid trace file " + path);
+    }
+    size_ = st.st_size;
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Failed to map trace file " + path);
+    }
+    data_ = static_cast<const char*>(data);
+    madvise(data, size_, MADV_SEQUENTIAL);
+    if (std::memcmp(data_, trace_magic, sizeof(trace_magic)) != 0) {
+        munmap(data, size_);
+        throw std::runtime_error("Invalid trace file " + path);
+    }
+}
+
+TraceReader::~TraceReader()
+{
+    munmap(const_cast<char*>(data_), size_);
+}
+
+bool TraceReader::next(TraceRecord& record)
+{
+    TraceRecordHeader header;
+    if (offset_ + sizeof(header) > size_) {
+        return false;
+    }
+    std::memcpy(&header, data_ + offset_, sizeof(header));
+    size_t end = offset_ + sizeof(header) + header.node_len + header.key_len;
+    if (end > size_) {
+        return false;
+    }
+    const char* node = data_ + offset_ + sizeof(header);
+    record.timestamp_ns = header.timestamp_ns;
+    record.event = static_cast<TraceEvent>(header.event);
+    record.arg = header.arg;
+    record.node = std::string_view(node, header.node_len);
+    record.key = std::string_view(node + header.node_len, header.key_len);
+    offset_ = end;
+    return true;
+}
+
+void TraceReader::rewind()
+{
+    offset_ = sizeof(trace_magic);
+}
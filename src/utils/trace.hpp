@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+enum class TraceEvent : uint8_t {
+    notification = 1,   // invalidator got a notification for key
+    read_hit = 2,       // node read key from its cache
+    read_miss = 3,      // node read key from the db, arg is the TTL in ms it was cached for
+    write = 4,          // node wrote key
+    invalidate = 5,     // invalidator deleted key from node
+    skip = 6,           // invalidator did not delete key from node, arg is a TraceSkipReason
+};
+
+enum class TraceSkipReason : uint32_t {
+    no_readers = 0,     // nobody read the key, node is empty
+    not_read = 1,       // node did not read the key
+    expired = 2,        // node read the key but its TTL already passed
+};
+
+/**
+ * a trace file starts with trace_magic followed by records, every record is a
+ * TraceRecordHeader followed by node_len bytes of node and key_len bytes of key.
+ * timestamps are nanoseconds since the epoch so traces of different processes can be merged
+*/
+const char trace_magic[8] = {'C', 'C', 'T', 'R', 'A', 'C', 'E', '1'};
+
+struct TraceRecordHeader {
+    uint64_t timestamp_ns;
+    uint32_t arg;
+    uint16_t key_len;
+    uint8_t node_len;
+    uint8_t event;
+};
+static_assert(sizeof(TraceRecordHeader) == 16, "trace record header must stay packed");
+
+struct TraceRecord {
+    uint64_t timestamp_ns;
+    TraceEvent event;
+    uint32_t arg;
+    std::string_view node;
+    std::string_view key;
+};
+
+/**
+ * thread safe append only writer, records are buffered and written in large chunks.
+ * every chunk is one write under flock so several processes can append to the same file
+*/
+class TraceWriter
+{
+    int fd_;
+    std::mutex lock_;
+    std::vector<char> buffer_;
+public:
+    explicit TraceWriter(const std::string& path);
+    ~TraceWriter();
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+    void record(TraceEvent event, std::string_view node, std::string_view key, uint32_t arg = 0);
+    void flush();
+private:
+    void flush_locked();
+};
+
+/**
+ * memory maps a trace file and iterates over its records without copying them
+*/
+class TraceReader
+{
+    const char* data_;
+    size_t size_;
+    size_t offset_;
+public:
+    explicit TraceReader(const std::string& path);
+    ~TraceReader();
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+    // returns false at the end of the trace, a truncated last record is ignored
+    bool next(TraceRecord& record);
+    void rewind();
+};
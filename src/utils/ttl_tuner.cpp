@@ -0,0 +1,83 @@
+#include <cmath>
+#include <algorithm>
+
+#include "ttl_tuner.hpp"
+
+TtlTuner::TtlTuner(Config config) :
+    config_(config)
+{}
+
+void TtlTuner::record_write(const std::string& key, time_point now)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    auto [iter, inserted] = stats_.try_emplace(key, WriteStats{now, 0.0, 1});
+    if (inserted) {
+        return;
+    }
+    auto& stats = iter->second;
+    double interval_ms = std::chrono::duration<double, std::milli>(now - stats.last_write).count();
+    if (stats.writes == 1) {
+        stats.mean_interval_ms = interval_ms;
+    } else {
+        stats.mean_interval_ms += config_.decay * (interval_ms - stats.mean_interval_ms);
+    }
+    stats.last_write = now;
+    stats.writes++;
+}
+
+double TtlTuner::clamped_target(const WriteStats& stats, time_point now) const
+{
+    // a key that stopped being written should not keep its old short interval
+    double idle_ms = std::chrono::duration<double, std::milli>(now - stats.last_write).count();
+    double mean_interval_ms = std::max(stats.mean_interval_ms, idle_ms);
+    double target = target_ttl(mean_interval_ms, config_.target_invalidations);
+    return std::clamp(target, config_.min_ttl_ms, config_.max_ttl_ms);
+}
+
+std::optional<double> TtlTuner::next_ttl(const std::string& key, double current_ttl_ms, time_point now)
+{
+    double target;
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        auto iter = stats_.find(key);
+        if (iter == stats_.end() || iter->second.writes < 2) {
+            return std::nullopt;
+        }
+        target = clamped_target(iter->second, now);
+    }
+    return current_ttl_ms + config_.step * (target - current_ttl_ms);
+}
+
+std::vector<std::pair<std::string, double>> TtlTuner::targets(time_point now)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+    std::vector<std::pair<std::string, double>> targets;
+    targets.reserve(stats_.size());
+    for (auto iter = stats_.begin(); iter != stats_.end();) {
+        double idle_ms = std::chrono::duration<double, std::milli>(now - iter->second.last_write).count();
+        if (idle_ms > config_.idle_evict_ms) {
+            iter = stats_.erase(iter);
+            continue;
+        }
+        if (iter->second.writes >= 2) {
+            targets.emplace_back(iter->first, clamped_target(iter->second, now));
+        }
+        ++iter;
+    }
+    return targets;
+}
+
+/*
+ * writes are treated as a poisson process, a value lives ttl after the write so the chance
+ * the next write arrives before it expires is 1 - e^(-ttl / interval)
+*/
+double TtlTuner::target_ttl(double mean_interval_ms, double target_invalidations)
+{
+    if (target_invalidations >= 1.0) {
+        return INFINITY;
+    }
+    if (target_invalidations <= 0.0) {
+        return 0.0;
+    }
+    return -mean_interval_ms * std::log1p(-target_invalidations);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+/**
+ * keeps a decayed estimate of the time between writes of every parameter and derives
+ * the TTL that gives a wanted number of invalidations per cached value
+*/
+class TtlTuner
+{
+public:
+    using time_point = std::chrono::system_clock::time_point;
+    struct Config {
+        double target_invalidations = 0.1; // expected invalidations per cached value, in (0, 1)
+        double decay = 0.2;                // weight of the newest write interval in the average
+        double step = 0.5;                 // fraction of the distance to the target TTL moved each round
+        double min_ttl_ms = 1000;          // must cover the invalidator's uncertainty plus notification latency
+        double max_ttl_ms = 60000;
+        double idle_evict_ms = 600000;     // keys not written for this long are forgotten
+    };
+    explicit TtlTuner(Config config);
+    void record_write(const std::string& key, time_point now);
+    // TTL the key should move to from current_ttl_ms, empty if there is not enough data yet
+    std::optional<double> next_ttl(const std::string& key, double current_ttl_ms, time_point now);
+    // clamped target TTL of every key with enough data, keys idle longer than idle_evict_ms are dropped
+    std::vector<std::pair<std::string, double>> targets(time_point now);
+    double step() const { return config_.step; }
+    // TTL for which a value has target_invalidations chance of being written before it expires
+    static double target_ttl(double mean_interval_ms, double target_invalidations);
+private:
+    struct WriteStats;
+    double clamped_target(const WriteStats& stats, time_point now) const;
+    struct WriteStats {
+        time_point last_write;
+        double mean_interval_ms;
+        unsigned long long writes;
+    };
+    Config config_;
+    std::mutex lock_;
+    std::unordered_map<std::string, WriteStats> stats_;
+};
@@ -55,7 +55,8 @@ std::chrono::system_clock::time_point parse_time(const std::string& timeStr) {
     return tp;
 }
 /**
- * rwiener;x.x.x.x:yyyy -> {rwiener:x.x.x.x:yyyy,...}
+ * rwiener@x.x.x.x:yyyy -> {rwiener:x.x.x.x:yyyy,...}
+ * a Redis Cluster is rwiener@cluster:x.x.x.x:yyyy -> {rwiener:cluster:x.x.x.x:yyyy,...}
 */
 std::map<std::string, std::string> parse_redis_data(std::string redis_data)
 {
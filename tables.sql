@@ -9,12 +9,16 @@ CREATE TABLE parameter_data (
 );
 
 --table that logs which client read data and when
+--value_timestamp is the timestamp of the value the client got, its copy lives until value_timestamp + ttl.
+--NULL means unknown and the invalidator always invalidates the reader
 CREATE TABLE read_log (
     id SERIAL PRIMARY KEY,
     username TEXT,
     read_timestamp TIMESTAMP,
-    parameter TEXT
+    parameter_name TEXT,
+    value_timestamp timestamp with time zone
 );
+-- existing tables: ALTER TABLE read_log ADD COLUMN value_timestamp timestamp with time zone;
 
 -- function to read data from parameter_data table
 -- since there is no trigger for select we use a function
@@ -26,11 +30,11 @@ BEGIN
 
     IF FOUND THEN
         UPDATE read_log
-        SET read_timestamp = NOW()
+        SET read_timestamp = NOW(), value_timestamp = result.timestamp
         WHERE username = session_user AND parameter_name = param_name;
         IF NOT FOUND THEN
-            INSERT INTO read_log (username, read_timestamp, parameter_name)
-            VALUES (session_user, NOW(), param_name);
+            INSERT INTO read_log (username, read_timestamp, parameter_name, value_timestamp)
+            VALUES (session_user, NOW(), param_name, result.timestamp);
         END IF;
     END IF;
 
@@ -48,9 +52,11 @@ BEGIN
 END
 $$ LANGUAGE plpgsql;
 
+-- only value writes need invalidations, ttl changes made by the invalidator's tuner do not
 CREATE TRIGGER update_queue_with_task
 AFTER UPDATE ON parameter_data
 FOR EACH ROW
+WHEN (OLD.parameter_value IS DISTINCT FROM NEW.parameter_value OR OLD.timestamp IS DISTINCT FROM NEW.timestamp)
 EXECUTE FUNCTION set_parameter();
 
 -- sql permission
@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+
+if [[ $# -lt 1 ]]; then
+    echo "Usage: $0 number of cluster nodes [first port]"
+    exit 1
+fi
+
+NODES=$1
+FIRST_PORT=${2:-7000}
+if [[ $NODES -lt 3 ]]; then
+    echo "a Redis Cluster needs at least 3 master nodes"
+    exit 1
+fi
+
+ADDRESSES=""
+for i in $(seq 0 $(($NODES-1))); do
+    PORT=$(($FIRST_PORT+$i))
+    DIR=/tmp/redis-cluster/$PORT
+    echo "starting cluster node on port $PORT"
+    mkdir -p $DIR
+    redis-server --port $PORT --cluster-enabled yes --cluster-config-file $DIR/nodes.conf \
+        --dir $DIR --appendonly no --save "" --daemonize yes --logfile $DIR/redis.log
+    ADDRESSES="$ADDRESSES 127.0.0.1:$PORT"
+done
+sleep 1
+redis-cli --cluster create $ADDRESSES --cluster-replicas 0 --cluster-yes
+echo "use username@cluster:127.0.0.1:$FIRST_PORT in --redis-servers of redis_invalidator"